@@ -42,6 +42,7 @@
  */
 
 #include "dsp/biquad.hpp"
+#include "numerichealth.hpp"
 
 struct AntiAliasingFilter{
     float overSampleFreq = 0.f;
@@ -103,6 +104,20 @@ struct AntiAliasingFilter{
             postDownSampleBuffer[i] = postUpSampleBuffer[i * 2];
         }
     }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void sanitize (NumericHealth &health){
+        health.sanitize(overSamplingFilter1);
+        health.sanitize(overSamplingFilter2);
+        health.sanitize(overSamplingFilter3);
+        health.sanitize(overSamplingFilter4);
+        health.sanitize(overSamplingFilter5);
+        health.sanitize(overSamplingFilter6);
+        health.sanitize(overSamplingFilter7);
+        health.sanitize(overSamplingFilter8);
+        health.sanitize(overSamplingFilter9);
+        health.sanitize(overSamplingFilter10);
+    }
 };
 
 /** @} */
\ No newline at end of file
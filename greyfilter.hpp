@@ -0,0 +1,120 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, Christopher Brand
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    greyfilter.hpp
+ * @brief   Grey noise filter fitted to the ISO 226 equal loudness contours
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "dsp/biquad.hpp"
+#include "numerichealth.hpp"
+
+// second order sections fitted offline to ISO 226:2003 with tools/greyfit.py, normalised to unity
+// power gain on white noise between 20Hz and 20kHz.  the poles below 100Hz are kept at a Q of 1
+// or less so the low end does not ring, which costs a few dB right at 20Hz.  the section holding
+// the poles next to DC is always first.  the max errors are from greyfit.py --check, float32 over
+// 20Hz to 12.5kHz.  each row is { ff0, ff1, ff2, fb1, fb2 } in dsp::BiQuad's convention
+static const float greyCoeffs[4][3][5] = {
+    {   // 20 phon, max error 11.68 dB
+        { 3.171421479e-01f, -5.117649003e-01f, 2.535734354e-01f, -1.996332784e+00f, 9.963461588e-01f },
+        { 6.703785706e-01f, -1.305547753e+00f, 6.359585731e-01f, -1.304511970e+00f, 3.073729275e-01f },
+        { 6.706503923e-01f, -1.305867495e+00f, 6.352175357e-01f, -1.304435915e+00f, 3.072995083e-01f },
+    },
+    {   // 40 phon, max error 9.65 dB
+        { 6.202529286e-01f, -9.926763808e-01f, 4.804570120e-01f, -1.996375866e+00f, 9.963889291e-01f },
+        { 6.888561477e-01f, -1.364666849e+00f, 6.758108851e-01f, -1.363169886e+00f, 3.661639954e-01f },
+        { 7.055414931e-01f, -1.364198739e+00f, 6.596965040e-01f, -1.363221394e+00f, 3.662153421e-01f },
+    },
+    {   // 60 phon, max error 9.26 dB
+        { 6.087182518e-01f, -8.907659230e-01f, 4.238002975e-01f, -1.593360283e+00f, 5.946341998e-01f },
+        { 1.028746171e+00f, -1.996018089e+00f, 9.686013797e-01f, -1.996677327e+00f, 9.966883125e-01f },
+        { 8.837055986e-01f, -1.133956120e+00f, 2.502519321e-01f, -7.258121790e-01f, 5.421014714e-01f },
+    },
+    {   // 80 phon, max error 5.87 dB
+        { 8.798144457e-01f, -9.973008098e-01f, 1.175005560e-01f, -1.542747885e+00f, 5.440799131e-01f },
+        { 1.313128200e+00f, -1.831443128e+00f, 8.494511635e-01f, -1.997006786e+00f, 9.970157054e-01f },
+        { 6.256460155e-01f, -1.225133133e+00f, 5.997812347e-01f, -8.315568732e-01f, 6.190035101e-01f },
+    }
+};
+
+struct GreyFilter{
+    enum {
+        k_sections = 3,
+        k_levels   = 4  // 20, 40, 60 and 80 phon
+    };
+
+    dsp::BiQuad section[k_sections];
+    uint8_t level;
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void init(const uint8_t level){
+        setLevel(level);
+    }
+
+    // load the coefficients for a loudness level.  the near DC poles hold a lot of energy in their
+    // state and each level scales it differently, so the state has to start over with the new
+    // coefficients or the output can jump far past full scale
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void setLevel(const uint8_t level){
+        this->level = level < k_levels ? level : k_levels - 1;
+
+        for (int i = 0; i < k_sections; i++){
+            const float *coeffs = greyCoeffs[this->level][i];
+            section[i].mCoeffs.ff0 = coeffs[0];
+            section[i].mCoeffs.ff1 = coeffs[1];
+            section[i].mCoeffs.ff2 = coeffs[2];
+            section[i].mCoeffs.fb1 = coeffs[3];
+            section[i].mCoeffs.fb2 = coeffs[4];
+            section[i].flush();
+        }
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    float process(const float xn){
+        return section[2].process_so(section[1].process_so(section[0].process_so(xn)));
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void sanitize(NumericHealth &health){
+        for (int i = 0; i < k_sections; i++){
+            health.sanitize(section[i]);
+        }
+    }
+};
+
+/** @} */
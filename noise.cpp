@@ -41,9 +41,47 @@
 #include "noise.hpp"
 #include "dsp/biquad.hpp"
 #include "antialiasingfilter.hpp"
+#include "noisetable.hpp"
+#include "numerichealth.hpp"
+#include "greyfilter.hpp"
+#include "noisemeter.hpp"
 
 static Noise s_Noise;
 
+#if NOISE_HEALTH_API
+// a consistent copy of the last block's counters, safe to call while another thread runs OSC_CYCLE.
+// on the device read s_Noise.health.stats with the debugger instead
+HealthStats noise_health_stats(void)
+{
+  return s_Noise.health.published.read();
+}
+
+// the totals are cleared by OSC_CYCLE at the start of its next block
+void noise_health_reset(void)
+{
+  s_Noise.health.requestReset();
+}
+#endif
+
+#if NOISE_METERING
+// a consistent copy of one color's meters, safe to call while another thread runs OSC_CYCLE.
+// color is the position on the shape knob, 0 for white up to 5 for grey, anything past that
+// returns empty stats.  on the device read s_Noise.meter.stats with the debugger instead
+MeterStats noise_meter_stats(uint8_t color)
+{
+  if (color >= BlockMeter::k_colors){
+    return MeterStats();
+  }
+  return s_Noise.meter.published[color].read();
+}
+
+// the meters are cleared by OSC_CYCLE at the end of its next block
+void noise_meter_reset(void)
+{
+  s_Noise.meter.requestReset();
+}
+#endif
+
 void OSC_INIT(uint32_t platform, uint32_t api)
 { 
   // prevents the compiler from complaining
@@ -62,36 +100,29 @@ void OSC_CYCLE(const user_osc_param_t * const params,
   q31_t * __restrict y = (q31_t *)yn;
   const q31_t * y_e = y + frames;
 
-  if (osc == Noise::k_flag_white){
-    float preUpSampleBuffer [frames] = {0};
-    float postUpSampleBuffer [frames *2] = {0};
-    float postDownSampleBuffer [frames] = {0};
+  if ((flags & Noise::k_flag_loop) && s_Noise.table.isReady(osc)){
+    // the table was captured after the anti-aliasing filter, so it can go straight to the output
+    s_Noise.meter.begin();
+    s_Noise.table.play(y, frames, s_Noise.meter);
+    s_Noise.meter.end(osc, frames);
+    return;
+  }
+
+  DenormalGuard denormalGuard;
 
+  float preUpSampleBuffer [frames] = {0};
+  float postUpSampleBuffer [frames *2] = {0};
+  float postDownSampleBuffer [frames] = {0};
+
+  if (osc == Noise::k_flag_white){
     // fill preUpsampleBuffer
     for (int i = 0; i < frames; i++){
       preUpSampleBuffer[i] = osc_white();
     }
-
-    // upsample (2x, going from 48kHz to 96kHz), populate postUpsampleBuffer
-    s_Noise.aAFilter.upsample(preUpSampleBuffer, postUpSampleBuffer, frames);
-
-    // do any processing needed (none)
-
-    // decimate to postDownsampleBuffer (1/2x, going from 96kHz to 48kHz)
-    s_Noise.aAFilter.decimate(postUpSampleBuffer, postDownSampleBuffer, frames);
-
-    // copy into real buffer
-    for (int i = 0; i < frames; i++){
-      *(y++) = f32_to_q31(postDownSampleBuffer[i]);
-    }    
   }
   else if (osc == Noise::k_flag_pink){
     // Voss - McCartney algorithm, this might be able to be implemented cleaner 
     // or we could do a -3db/oct filter on white noise
-    float preUpSampleBuffer [frames] = {0};
-    float postUpSampleBuffer [frames *2] = {0};
-    float postDownSampleBuffer [frames] = {0};
-
     uint8_t counter = s.counter;
     s.counter= s.counter + (frames % 128);    
     if (s.counter>127){
@@ -131,55 +162,21 @@ void OSC_CYCLE(const user_osc_param_t * const params,
         counter = 0.f;
       }
     }
-
-    // upsample (2x, going from 48kHz to 96kHz), populate postUpsampleBuffer
-    s_Noise.aAFilter.upsample(preUpSampleBuffer, postUpSampleBuffer, frames);
-
-    // do any processing needed (none)
-
-    // decimate to postDownsampleBuffer (1/2x, going from 96kHz to 48kHz)
-    s_Noise.aAFilter.decimate(postUpSampleBuffer, postDownSampleBuffer, frames);
-
-    // copy into real buffer
-    for (int i = 0; i < frames; i++){
-      *(y++) = f32_to_q31(postDownSampleBuffer[i]);
-    }
   }
   else if (osc == Noise::k_flag_brown){
     // 6.02db/octave low pass filter on white noise, use first order filter
     const float ampAdjust = 1.99f;  // brown is a bit quiet so lets boost it some
 
-    float preUpSampleBuffer [frames] = {0};
-    float postUpSampleBuffer [frames *2] = {0};
-    float postDownSampleBuffer [frames] = {0};
-
     // fill preUpsampleBuffer
     for (int i = 0; i < frames; i++){
       preUpSampleBuffer[i] = ampAdjust * s_Noise.brownFilter.process_fo(osc_white());
     }
-
-    // upsample (2x, going from 48kHz to 96kHz), populate postUpsampleBuffer
-    s_Noise.aAFilter.upsample(preUpSampleBuffer, postUpSampleBuffer, frames);
-
-    // do any processing needed (none)
-
-    // decimate to postDownsampleBuffer (1/2x, going from 96kHz to 48kHz)
-    s_Noise.aAFilter.decimate(postUpSampleBuffer, postDownSampleBuffer, frames);
-
-    // copy into real buffer
-    for (int i = 0; i < frames; i++){
-      *(y++) = f32_to_q31(postDownSampleBuffer[i]);
-    }    
   }
   else if (osc == Noise::k_flag_blue){
     // we are going to use pink noise and take the difference of successive samples, aka, pink noise with a first differential operator
     // Voss - McCartney algorithm, this might be able to be implemented cleaner
     const float ampAdjust = 1.99f;  // lets boost it some
 
-    float preUpSampleBuffer [frames] = {0};
-    float postUpSampleBuffer [frames *2] = {0};
-    float postDownSampleBuffer [frames] = {0};
-
     uint8_t blueCounter = s.counter;
     s.counter= s.counter + (frames % 128);    
     if (s.counter>127){
@@ -220,77 +217,54 @@ void OSC_CYCLE(const user_osc_param_t * const params,
         blueCounter = 0.f;
       }
     }
-
-    // upsample (2x, going from 48kHz to 96kHz), populate postUpsampleBuffer
-    s_Noise.aAFilter.upsample(preUpSampleBuffer, postUpSampleBuffer, frames);
-
-    // do any processing needed (none)
-
-    // decimate to postDownsampleBuffer (1/2x, going from 96kHz to 48kHz)
-    s_Noise.aAFilter.decimate(postUpSampleBuffer, postDownSampleBuffer, frames);
-
-    // copy into real buffer
-    for (int i = 0; i < frames; i++){
-      *(y++) = f32_to_q31(postDownSampleBuffer[i]);
-    }
   }
   else if (osc == Noise::k_flag_violet){
    // 6.02db/octave high pass filter on white noise, use first order filter
     const float ampAdjust = 1.99f;  // lets boost it some
 
-    float preUpSampleBuffer [frames] = {0};
-    float postUpSampleBuffer [frames *2] = {0};
-    float postDownSampleBuffer [frames] = {0};
-
     // fill preUpsampleBuffer
     for (int i = 0; i < frames; i++){
       preUpSampleBuffer[i] = ampAdjust * s_Noise.violetFilter.process_fo(osc_white());
     }
-
-    // upsample (2x, going from 48kHz to 96kHz), populate postUpsampleBuffer
-    s_Noise.aAFilter.upsample(preUpSampleBuffer, postUpSampleBuffer, frames);
-
-    // do any processing needed (none)
-
-    // decimate to postDownsampleBuffer (1/2x, going from 96kHz to 48kHz)
-    s_Noise.aAFilter.decimate(postUpSampleBuffer, postDownSampleBuffer, frames);
-
-    // copy into real buffer
-    for (int i = 0; i < frames; i++){
-      *(y++) = f32_to_q31(postDownSampleBuffer[i]);
-    }    
   }
   else{
-    // grey
-    const float ampAdjust = 1.99f;  // lets boost it some
+    // grey, the fitted filter has unity power gain over 20Hz - 20kHz so its overall level is close
+    // to white, but most of that power is in the low end and the mids sit 8-34dB below white.
+    // the low end pushes the peaks up, at unity about 0.08% of samples reach full scale
+    const float ampAdjust = .7f;  // so cut it some
+    GreyFilter &grey = s_Noise.greyFilter;
 
-    float preUpSampleBuffer [frames] = {0};
-    float postUpSampleBuffer [frames *2] = {0};
-    float postDownSampleBuffer [frames] = {0};
-
-  // fill preUpsampleBuffer
+    // fill preUpsampleBuffer
     for (int i = 0; i < frames; i++){
-      float whiteNoise = osc_white();
-      float intermediate;
-      
-      intermediate = s_Noise.greyLPFilter.process_so(whiteNoise);
-      intermediate += s_Noise.greyHP3Filter.process_so(s_Noise.greyHP2Filter.process_so(s_Noise.greyHP1Filter.process_so(whiteNoise)));
-
-      preUpSampleBuffer[i] = ampAdjust * (intermediate/2.f);
+      preUpSampleBuffer[i] = ampAdjust * grey.process(osc_white());
     }
+  }
 
-    // upsample (2x, going from 48kHz to 96kHz), populate postUpsampleBuffer
-    s_Noise.aAFilter.upsample(preUpSampleBuffer, postUpSampleBuffer, frames);
+  // upsample (2x, going from 48kHz to 96kHz), populate postUpsampleBuffer
+  s_Noise.aAFilter.upsample(preUpSampleBuffer, postUpSampleBuffer, frames);
 
-    // do any processing needed (none)
+  // do any processing needed (none)
 
-    // decimate to postDownsampleBuffer (1/2x, going from 96kHz to 48kHz)
-    s_Noise.aAFilter.decimate(postUpSampleBuffer, postDownSampleBuffer, frames);
+  // decimate to postDownsampleBuffer (1/2x, going from 96kHz to 48kHz)
+  s_Noise.aAFilter.decimate(postUpSampleBuffer, postDownSampleBuffer, frames);
 
-    // copy into real buffer
-    for (int i = 0; i < frames; i++){
-      *(y++) = f32_to_q31(postDownSampleBuffer[i]);
+  // copy into real buffer, metering on the way
+  s_Noise.meter.begin();
+  for (int i = 0; i < frames; i++){
+    s_Noise.meter.add(postDownSampleBuffer[i]);
+    *(y++) = f32_to_q31(postDownSampleBuffer[i]);
+  }
+  s_Noise.meter.end(osc, frames);
+
+  // keep the filter states out of the subnormal range for the next block
+  s_Noise.sanitize();
+
+  if (flags & Noise::k_flag_loop){
+    // keep filling the table until it holds a full loop of this color
+    if (s_Noise.table.color != osc){
+      s_Noise.table.reset(osc);
     }
+    s_Noise.table.capture(postDownSampleBuffer, frames);
   }
 }
 
@@ -310,8 +284,17 @@ void OSC_PARAM(uint16_t index, uint16_t value)
   Noise::State &s = s_Noise.state;
 
   switch (index) {
+  case k_user_osc_param_id2:
+    // loop a pre-rendered table instead of generating every sample
+    if (value){
+      s.flags |= Noise::k_flag_loop;
+    }
+    else{
+      s.flags &= ~Noise::k_flag_loop;
+    }
+    break;
+
   case k_user_osc_param_id1:
-  case k_user_osc_param_id2:    
   case k_user_osc_param_id3:
   case k_user_osc_param_id4:
   case k_user_osc_param_id5:    
@@ -345,8 +328,25 @@ void OSC_PARAM(uint16_t index, uint16_t value)
       break;
     }
   case k_user_osc_param_shiftshape:
-    // 10bit parameter
-    break;
+    {
+      // 10bit parameter, picks the loudness level grey noise follows
+      const float user_osc_param = param_val_to_f32(value);
+      uint8_t level = (uint8_t)(user_osc_param * GreyFilter::k_levels);
+      if (level >= GreyFilter::k_levels){
+        level = GreyFilter::k_levels - 1;
+      }
+
+      if (level != s.grey_level){
+        s.grey_level = level;
+        s_Noise.greyFilter.setLevel(level);
+
+        // a grey table captured at the old level no longer matches
+        if (s_Noise.table.color == Noise::k_flag_grey){
+          s_Noise.table.reset(Noise::k_flag_grey);
+        }
+      }
+      break;
+    }
     
   default:
     break;
@@ -42,11 +42,16 @@
 #include "userosc.h"
 #include "biquad.hpp"
 #include "antialiasingfilter.hpp"
+#include "noisetable.hpp"
+#include "numerichealth.hpp"
+#include "greyfilter.hpp"
+#include "noisemeter.hpp"
 
 struct Noise{
   enum {
     k_flags_none   = 0,
-    k_flag_reset  = 1<<1
+    k_flag_reset  = 1<<1,
+    k_flag_loop   = 1<<2
   };
 
   enum {
@@ -65,6 +70,7 @@ struct Noise{
     float angle;
     float lfo, lfoz;
     uint8_t noise_type;
+    uint8_t grey_level;
 
     // for pink noise generation
     uint8_t counter;
@@ -100,26 +106,52 @@ struct Noise{
     state = State();
     state.flags = k_flags_none;
     state.noise_type = k_flag_white;
+    state.grey_level = 3;   // 80 phon
     state.counter=0.0f;
     state.blueCounter=0.f;
 
     brownFilter.mCoeffs.setFOLP(tan(PI* brownFilter.mCoeffs.wc(16.35f, k_samplerate_recipf)));
     violetFilter.mCoeffs.setFOHP(tan(PI* violetFilter.mCoeffs.wc(16744.04f, k_samplerate_recipf)));
 
-    greyLPFilter.mCoeffs.setSOLP(tan(PI* greyLPFilter.mCoeffs.wc(500.f,k_samplerate_recipf)), 1.f);
-    greyHP1Filter.mCoeffs.setSOHP(tan(PI* greyHP1Filter.mCoeffs.wc(10000.f,k_samplerate_recipf)), 1.f);  
-    greyHP2Filter.mCoeffs.setSOHP(tan(PI* greyHP2Filter.mCoeffs.wc(10000.f,k_samplerate_recipf)), 1.f);  
-    greyHP3Filter.mCoeffs.setSOHP(tan(PI* greyHP3Filter.mCoeffs.wc(10000.f,k_samplerate_recipf)), 1.f);  
+    greyFilter.init(state.grey_level);
 
     aAFilter.init(24000.f);
+    table.init();
+    health.init();
+    meter.init();
+  }
+
+  // flush tiny states and clear any filter that went NaN or infinite, run once per block
+  void sanitize(void) {
+    health.beginBlock();
+
+    health.sanitize(brownFilter);
+    health.sanitize(violetFilter);
+    greyFilter.sanitize(health);
+    aAFilter.sanitize(health);
+
+    health.endBlock();
   }
 
   State state;
 
   dsp::BiQuad brownFilter;
   dsp::BiQuad violetFilter;
-  dsp::BiQuad greyLPFilter;
-  dsp::BiQuad greyHP1Filter, greyHP2Filter, greyHP3Filter;
+  GreyFilter greyFilter;
   AntiAliasingFilter aAFilter;
+  NoiseTable table;
+  NumericHealth health;
+  BlockMeter meter;
 };
 
+#if NOISE_HEALTH_API
+// host side access to the filter state health counters, see noise.cpp
+HealthStats noise_health_stats(void);
+void noise_health_reset(void);
+#endif
+
+#if NOISE_METERING
+// host side access to the per color meters, see noise.cpp
+MeterStats noise_meter_stats(uint8_t color);
+void noise_meter_reset(void);
+#endif
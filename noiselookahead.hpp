@@ -0,0 +1,272 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, Christopher Brand
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    noiselookahead.hpp
+ * @brief   Host side lookahead producer feeding audio callbacks from a lock-free ring
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+/*
+ * Host builds only, the unit has no threads and noise.cpp does not include this.
+ *
+ * Noise has no input so it can be rendered ahead of time.  A producer thread runs OSC_CYCLE
+ * into a single producer / single consumer ring of blocks and the audio callback only copies
+ * out of blocks that are already done, so callback time no longer depends on the noise type.
+ * The ring is sized from the largest buffer the host will ask for, with a floor of about 43ms.
+ *
+ * All calls into the oscillator happen on the producer thread.  param() keeps the latest value
+ * of each parameter and the producer applies the ones that changed before the next block is
+ * rendered, so a burst of changes can never be dropped.  Every block is tagged with the
+ * parameter generation it was rendered with.  Once a block from a newer generation is in the
+ * ring the callback skips the older ones, so a change is heard about one callback later no
+ * matter how deep the ring is.
+ *
+ *   NoiseLookahead lookahead(maxFrames);
+ *   lookahead.start();
+ *   ...
+ *   lookahead.param(k_user_osc_param_shape, value);   // any thread
+ *   lookahead.read(yn, frames);                       // audio callback, frames <= maxFrames
+ *   ...
+ *   lookahead.stop();
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <string.h>
+#include "userosc.h"
+
+// lock-free ring for exactly one producer thread and one consumer thread, the capacity is
+// rounded up to a power of two
+template <typename T>
+struct SpscRing{
+    std::unique_ptr<T[]> slots;
+    uint32_t mask;
+    std::atomic<uint32_t> head;     // next slot to write, only the producer stores it
+    std::atomic<uint32_t> tail;     // next slot to read, only the consumer stores it
+
+    explicit SpscRing(const uint32_t capacity) : head(0), tail(0) {
+        uint32_t size = 1;
+        while (size < capacity){
+            size <<= 1;
+        }
+        slots.reset(new T[size]);
+        mask = size - 1;
+    }
+
+    uint32_t capacity(void) const {
+        return mask + 1;
+    }
+
+    // producer side: slot to fill or nullptr when full, commit() publishes it
+    T *writeSlot(void){
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == capacity()){
+            return nullptr;
+        }
+        return &slots[h & mask];
+    }
+
+    void commit(void){
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer side: oldest ready slot or nullptr when empty, release() hands it back
+    T *readSlot(void){
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t){
+            return nullptr;
+        }
+        return &slots[t & mask];
+    }
+
+    // consumer side: most recently published slot, it stays valid until the consumer releases it
+    T *newestSlot(void){
+        const uint32_t h = head.load(std::memory_order_acquire);
+        if (h == tail.load(std::memory_order_relaxed)){
+            return nullptr;
+        }
+        return &slots[(h - 1) & mask];
+    }
+
+    void release(void){
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+struct NoiseLookahead{
+    enum {
+        k_block_frames = 64,    // largest block the unit asks OSC_CYCLE for
+        k_min_blocks   = 32     // about 43ms, rides out a producer that wakes late from its poll
+    };
+
+    struct Block{
+        int32_t frames[k_block_frames];
+        uint32_t generation;    // parameter generation the block was rendered with
+    };
+
+    SpscRing<Block> blocks;
+
+    // latest value of every parameter, a set bit in paramDirty means the producer has not
+    // applied it yet
+    std::atomic<uint16_t> paramValues[k_num_user_osc_param_id];
+    std::atomic<uint32_t> paramDirty;
+
+    user_osc_param_t cycleParams;
+    std::thread producer;
+    std::atomic<bool> running;
+
+    // consumer side only
+    uint32_t readOffset;                // frames already copied out of the oldest block
+    std::atomic<uint32_t> underruns;    // callbacks that found the ring empty
+
+    // room for two of the largest callbacks plus the block that is partly read, so one callback
+    // can drain while the producer refills behind it, and never less than k_min_blocks.  depth
+    // only costs memory, stale blocks are skipped so parameter changes do not wait behind it
+    static uint32_t ringBlocks(const uint32_t maxFrames){
+        const uint32_t blocks = 2 * ((maxFrames + k_block_frames - 1) / k_block_frames + 1);
+        return blocks > k_min_blocks ? blocks : k_min_blocks;
+    }
+
+    explicit NoiseLookahead(const uint32_t maxFrames)
+        : blocks(ringBlocks(maxFrames)),
+          paramDirty(0), running(false), readOffset(0), underruns(0) {
+        for (int i = 0; i < k_num_user_osc_param_id; i++){
+            paramValues[i].store(0, std::memory_order_relaxed);
+        }
+        memset(&cycleParams, 0, sizeof(cycleParams));
+    }
+
+    ~NoiseLookahead(void) {
+        stop();
+    }
+
+    void start(void){
+        if (running.exchange(true)){
+            return;
+        }
+        producer = std::thread(&NoiseLookahead::produce, this);
+    }
+
+    void stop(void){
+        if (running.exchange(false)){
+            producer.join();
+        }
+    }
+
+    // hand a parameter change to the producer, safe from any thread.  a newer value for the same
+    // parameter replaces one that has not been applied yet
+    void param(const uint16_t index, const uint16_t value){
+        if (index >= k_num_user_osc_param_id){
+            return;
+        }
+        paramValues[index].store(value, std::memory_order_relaxed);
+        paramDirty.fetch_or(1u << index, std::memory_order_release);
+    }
+
+    // audio callback: copy out of ready blocks using only atomics and memcpy, no locks, system
+    // calls or allocation.  if the producer fell behind the rest of the buffer is silent and the
+    // underrun is counted
+    void read(int32_t *yn, uint32_t frames){
+        bool underrun = false;
+
+        while (frames){
+            Block *block = blocks.readSlot();
+            if (!block){
+                memset(yn, 0, frames * sizeof(int32_t));
+                underrun = true;
+                break;
+            }
+
+            // rendered before the last parameter change and the new sound is already waiting
+            if (block->generation != blocks.newestSlot()->generation){
+                readOffset = 0;
+                blocks.release();
+                continue;
+            }
+
+            uint32_t count = k_block_frames - readOffset;
+            count = count < frames ? count : frames;
+            memcpy(yn, block->frames + readOffset, count * sizeof(int32_t));
+
+            yn += count;
+            frames -= count;
+            readOffset += count;
+            if (readOffset == k_block_frames){
+                readOffset = 0;
+                blocks.release();
+            }
+        }
+
+        if (underrun){
+            underruns++;
+        }
+    }
+
+    void produce(void){
+        // nothing wakes the producer, it polls this often while the ring is full.  a quarter of a
+        // block keeps a freed slot or a parameter change waiting well under one block
+        const std::chrono::microseconds poll(k_block_frames * 1000000 / k_samplerate / 4);
+        uint32_t generation = 0;
+
+        while (running.load(std::memory_order_relaxed)){
+            const uint32_t dirty = paramDirty.exchange(0, std::memory_order_acquire);
+            for (int i = 0; i < k_num_user_osc_param_id; i++){
+                if (dirty & (1u << i)){
+                    OSC_PARAM(i, paramValues[i].load(std::memory_order_relaxed));
+                }
+            }
+            if (dirty){
+                generation++;
+            }
+
+            Block *block = blocks.writeSlot();
+            if (!block){
+                std::this_thread::sleep_for(poll);
+                continue;
+            }
+
+            OSC_CYCLE(&cycleParams, block->frames, k_block_frames);
+            block->generation = generation;
+            blocks.commit();
+        }
+    }
+};
+
+/** @} */
@@ -0,0 +1,141 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, Christopher Brand
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    noisemeter.hpp
+ * @brief   Per block level metering: RMS, peak, crest factor and clip counts
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "userosc.h"
+#include "snapshot.hpp"
+
+// metering costs a multiply, an abs and two compares per sample so it is off by default,
+// enable with UDEFS = -DNOISE_METERING=1 in project.mk
+#ifndef NOISE_METERING
+#define NOISE_METERING 0
+#endif
+
+struct MeterStats{
+    float rms;          // last block
+    float peak;         // last block
+    float crest;        // peak / rms of the last block
+    float runningRms;   // smoothed over blocks
+    uint32_t clipped;   // samples at or past full scale going into f32_to_q31, since reset
+    uint32_t blocks;    // blocks metered since reset
+};
+
+struct BlockMeter{
+#if NOISE_METERING
+    enum {
+        k_colors = 6
+    };
+
+    MeterStats stats[k_colors];
+    Snapshot<MeterStats> published[k_colors];  // copies for other threads, see noise_meter_stats()
+    uint32_t resetRequest;                      // set from any thread, handled at the end of the next block
+
+    float sumSquares;
+    float peak;
+    uint32_t clipped;
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void init(void){
+        for (int i = 0; i < k_colors; i++){
+            stats[i] = MeterStats();
+            published[i].init();
+        }
+        resetRequest = 0;
+    }
+
+    // ask the thread running OSC_CYCLE to clear the meters, safe from any thread
+    inline void requestReset(void){
+        __atomic_store_n(&resetRequest, 1, __ATOMIC_RELAXED);
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void begin(void){
+        sumSquares = 0.f;
+        peak = 0.f;
+        clipped = 0;
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void add(const float xn){
+        const float level = si_fabsf(xn);
+        sumSquares += xn * xn;
+        peak = level > peak ? level : peak;
+        clipped += level >= 1.f;
+    }
+
+    // noise types are single bit flags (white is 0) so the bit position is the color index
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void end(const uint8_t noise_type, const uint32_t frames){
+        const float smoothing = .05f;   // one pole on the mean square, about 20 blocks to settle
+
+        if (__atomic_exchange_n(&resetRequest, 0, __ATOMIC_RELAXED)){
+            for (int i = 0; i < k_colors; i++){
+                stats[i] = MeterStats();
+                published[i].publish(stats[i]);
+            }
+        }
+
+        const int index = noise_type ? __builtin_ctz(noise_type) : 0;
+        MeterStats &color = stats[index];
+        const float meanSquare = sumSquares / frames;
+
+        color.rms = sqrtf(meanSquare);
+        color.peak = peak;
+        color.crest = color.rms > 0.f ? peak / color.rms : 0.f;
+        // start from the first block instead of rising from silence
+        const float runningSquare = color.blocks ? color.runningRms * color.runningRms : meanSquare;
+        color.runningRms = sqrtf(runningSquare + smoothing * (meanSquare - runningSquare));
+        color.clipped += clipped;
+        color.blocks++;
+
+        published[index].publish(color);
+    }
+#else
+    inline void init(void) {}
+    inline void requestReset(void) {}
+    inline void begin(void) {}
+    inline void add(const float xn) { (void)xn; }
+    inline void end(const uint8_t noise_type, const uint32_t frames) { (void)noise_type; (void)frames; }
+#endif
+};
+
+/** @} */
@@ -0,0 +1,154 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, Christopher Brand
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    noisetable.hpp
+ * @brief   Looped pre-rendered noise table
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include "userosc.h"
+#include "noisemeter.hpp"
+
+// table length in samples, each sample is a q15 so the default of 4096 (85ms) uses 8KB of the
+// 32KB the unit gets for code and data.  override with UDEFS = -DNOISE_TABLE_LENGTH=... in project.mk
+#ifndef NOISE_TABLE_LENGTH
+#define NOISE_TABLE_LENGTH 4096
+#endif
+
+// time played from one offset before jumping to the next, longer means fewer jumps but fewer
+// distinct offsets to pick from
+#ifndef NOISE_TABLE_SEGMENT_MS
+#define NOISE_TABLE_SEGMENT_MS 40
+#endif
+
+struct NoiseTable{
+    enum {
+        k_length  = NOISE_TABLE_LENGTH,
+        k_xfade   = 128,                // crossfade length at each loop point
+        k_segment = NOISE_TABLE_SEGMENT_MS * k_samplerate / 1000    // samples played before jumping to a new offset
+    };
+
+    static_assert(k_segment + k_xfade <= k_length, "NOISE_TABLE_LENGTH is too short for NOISE_TABLE_SEGMENT_MS");
+
+    q15_t table[k_length];
+    float fadeIn[k_xfade];      // equal power fade in gains, fade out is the same table read backwards
+
+    uint32_t writePos;
+    uint32_t readPos;           // current read head
+    uint32_t fadePos;           // read head being faded out
+    uint32_t segmentRemain;     // samples left before the next loop point
+    uint32_t fadeRemain;        // samples left in the current crossfade
+    uint8_t color;
+    bool ready;
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void init(void){
+        // the noise in both heads is uncorrelated, so use equal power gains to avoid a dip mid fade
+        for (int i = 0; i < k_xfade; i++){
+            fadeIn[i] = sqrtf((i + .5f) / k_xfade);
+        }
+        reset(0xFF);
+    }
+
+    // throw away the table and start capturing a new color
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void reset(const uint8_t color){
+        this->color = color;
+        writePos = 0;
+        ready = false;
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    bool isReady(const uint8_t color) const {
+        return ready && this->color == color;
+    }
+
+    // store the output of the live generator, once the table is full playback can start
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void capture(const float buffer[], const uint32_t frames){
+        for (uint32_t i = 0; i < frames && writePos < k_length; i++){
+            table[writePos++] = f32_to_q15(clip1m1f(buffer[i]));
+        }
+
+        if (writePos == k_length && !ready){
+            readPos = randomOffset();
+            segmentRemain = k_segment;
+            fadeRemain = 0;
+            ready = true;
+        }
+    }
+
+    // stream from the table, jumping to a random offset every segment with a crossfade so the loop is not heard
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void play(q31_t * __restrict y, const uint32_t frames, BlockMeter &meter){
+        for (uint32_t i = 0; i < frames; i++){
+            if (segmentRemain == 0){
+                fadePos = readPos;
+                readPos = randomOffset();
+                segmentRemain = k_segment;
+                fadeRemain = k_xfade;
+            }
+
+            if (fadeRemain){
+                // only the crossfade goes through float, the equal power sum of two uncorrelated segments
+                // can peak at about 1.41 so it is clipped back to full scale
+                const uint32_t idx = k_xfade - fadeRemain;
+                const float sample = clip1m1f(fadeIn[idx] * q15_to_f32(table[readPos]) + fadeIn[k_xfade - 1 - idx] * q15_to_f32(table[fadePos]));
+                meter.add(sample);
+                *(y++) = f32_to_q31(sample);
+                fadePos++;
+                fadeRemain--;
+            }
+            else{
+                meter.add(q15_to_f32(table[readPos]));
+                *(y++) = q15_to_q31(table[readPos]);
+            }
+
+            readPos++;
+            segmentRemain--;
+        }
+    }
+
+    // any start that leaves room for a full segment plus the fade out that follows it
+    inline __attribute__((optimize("Ofast"),always_inline))
+    uint32_t randomOffset(void){
+        return osc_rand() % (k_length - k_segment - k_xfade + 1);
+    }
+};
+
+/** @} */
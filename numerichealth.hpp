@@ -0,0 +1,168 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, Christopher Brand
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    numerichealth.hpp
+ * @brief   Denormal protection and numerical health counters for filter states
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <string.h>
+#include "dsp/biquad.hpp"
+#include "snapshot.hpp"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// filter states with a biased exponent below this (about 1e-20) are flushed to zero before
+// they can decay into the subnormal range
+#define NUMERIC_HEALTH_FLUSH_EXPONENT 60
+
+// publishes the counters for noise_health_stats() and noise_health_reset(), the counting itself
+// is always on. enable with UDEFS = -DNOISE_HEALTH_API=1 in project.mk
+#ifndef NOISE_HEALTH_API
+#define NOISE_HEALTH_API 0
+#endif
+
+struct HealthStats{
+    // events seen during the last block
+    uint32_t flushed;       // states flushed to zero for being below about 1e-20
+    uint32_t nan;           // states that were NaN, the filter is cleared
+    uint32_t overflow;      // states that were infinite, the filter is cleared
+
+    // running totals since init or the last reset
+    uint32_t flushedTotal;
+    uint32_t nanTotal;
+    uint32_t overflowTotal;
+};
+
+struct NumericHealth{
+    HealthStats stats;
+#if NOISE_HEALTH_API
+    Snapshot<HealthStats> published;    // copy of stats for other threads, see noise_health_stats()
+    uint32_t resetRequest;              // set from any thread, handled at the next block
+#endif
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void init(void){
+        stats = HealthStats();
+#if NOISE_HEALTH_API
+        published.init();
+        resetRequest = 0;
+#endif
+    }
+
+#if NOISE_HEALTH_API
+    // ask the thread running OSC_CYCLE to clear the totals, safe from any thread
+    inline void requestReset(void){
+        __atomic_store_n(&resetRequest, 1, __ATOMIC_RELAXED);
+    }
+#endif
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void beginBlock(void){
+#if NOISE_HEALTH_API
+        if (__atomic_exchange_n(&resetRequest, 0, __ATOMIC_RELAXED)){
+            stats = HealthStats();
+        }
+#endif
+        stats.flushed = stats.nan = stats.overflow = 0;
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void endBlock(void){
+#if NOISE_HEALTH_API
+        published.publish(stats);
+#endif
+    }
+
+    inline __attribute__((optimize("Ofast"),always_inline))
+    void sanitize(dsp::BiQuad &filter){
+        // a NaN or infinity never leaves a recursive filter on its own, so start it over
+        if (!checkState(filter.mZ1) || !checkState(filter.mZ2)){
+            filter.flush();
+        }
+    }
+
+    // returns false if the state is no longer finite, uses the bits directly since
+    // Ofast lets the compiler assume isnan() and isinf() are always false
+    inline __attribute__((optimize("Ofast"),always_inline))
+    bool checkState(float &z){
+        uint32_t bits;
+        memcpy(&bits, &z, sizeof(bits));
+        const uint32_t exponent = (bits >> 23) & 0xFF;
+
+        if (exponent == 0xFF){
+            if (bits & 0x7FFFFF){
+                stats.nan++;
+                stats.nanTotal++;
+            }
+            else{
+                stats.overflow++;
+                stats.overflowTotal++;
+            }
+            return false;
+        }
+
+        if (exponent < NUMERIC_HEALTH_FLUSH_EXPONENT && (bits & 0x7FFFFFFF)){
+            z = 0.f;
+            stats.flushed++;
+            stats.flushedTotal++;
+        }
+        return true;
+    }
+};
+
+// sets flush-to-zero and denormals-are-zero for the lifetime of the guard on hosts with SSE.
+// the M4 has no slowdown on subnormals and its FPSCR belongs to the firmware, so there the
+// state flushing above is all we do
+struct DenormalGuard{
+#if defined(__SSE__)
+    unsigned int savedCsr;
+
+    DenormalGuard(void) : savedCsr(_mm_getcsr()) {
+        _mm_setcsr(savedCsr | 0x8040);  // FTZ | DAZ
+    }
+
+    ~DenormalGuard(void) {
+        _mm_setcsr(savedCsr);
+    }
+#endif
+};
+
+/** @} */
@@ -0,0 +1,100 @@
+#pragma once
+/*
+    BSD 3-Clause License
+
+    Copyright (c) 2023, Christopher Brand
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice, this
+      list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+    * Neither the name of the copyright holder nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+    FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+    DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+    SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//*/
+
+/**
+ * @file    snapshot.hpp
+ * @brief   Seqlock for reading stats written by the thread running OSC_CYCLE
+ *
+ * @addtogroup dsp DSP
+ * @{
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+// one writer publishes a copy of T once per block, readers on any thread get a consistent copy
+// without ever blocking the writer.  T must be made of 32 bit fields
+template <typename T>
+struct Snapshot{
+    enum {
+        k_words = sizeof(T) / sizeof(uint32_t)
+    };
+
+    static_assert(sizeof(T) % sizeof(uint32_t) == 0, "Snapshot needs a type made of 32 bit fields");
+
+    uint32_t words[k_words];
+    uint32_t sequence;          // odd while a publish is in progress
+
+    inline void init(void){
+        memset(words, 0, sizeof(words));
+        sequence = 0;
+    }
+
+    // writer side, only ever called from one thread
+    inline __attribute__((always_inline))
+    void publish(const T &value){
+        uint32_t src[k_words];
+        memcpy(src, &value, sizeof(src));
+
+        const uint32_t seq = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+        __atomic_store_n(&sequence, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        for (int i = 0; i < k_words; i++){
+            __atomic_store_n(&words[i], src[i], __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&sequence, seq + 2, __ATOMIC_RELEASE);
+    }
+
+    // reader side, retries while the writer is in the middle of a publish
+    inline T read(void) const {
+        uint32_t dst[k_words];
+        uint32_t before, after;
+
+        do {
+            before = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+            for (int i = 0; i < k_words; i++){
+                dst[i] = __atomic_load_n(&words[i], __ATOMIC_RELAXED);
+            }
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+        } while ((before & 1) || before != after);
+
+        T value;
+        memcpy(&value, dst, sizeof(value));
+        return value;
+    }
+};
+
+/** @} */
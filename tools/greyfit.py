@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+"""
+Fits the grey noise filters in greyfilter.hpp.
+
+Each phon level gets a cascade of second order sections whose magnitude
+follows the ISO 226:2003 equal loudness contour, normalised so the filter has
+unity power gain on white noise between 20Hz and 20kHz.  The coefficients are
+printed in the layout of the greyCoeffs table and use the same sign convention
+as dsp::BiQuad (y = ff0 x + ff1 x1 + ff2 x2 - fb1 y1 - fb2 y2).  The section
+with the pole closest to DC always comes first so switching levels never
+moves the near DC poles to a different slot.
+
+Only the first section may put its poles below LOW_POLE_MAX_F and their Q is
+capped at LOW_POLE_MAX_Q.  Left free, the fit follows the steep rise of the
+contour towards 20Hz with a high Q pole pair just above it that rings.
+
+The max error in each comment is measured the same way as --check, on the
+printed coefficients run in float32.
+
+    python3 tools/greyfit.py > coeffs.txt
+
+--check runs the table in greyfilter.hpp in float32 the way GreyFilter does:
+the error of its impulse response against the contour, the level at 1kHz, the
+share of power below 20Hz and the highest Q pole below LOW_POLE_MAX_F, then the
+peak while sweeping through the levels on running noise.
+
+    python3 tools/greyfit.py --check
+
+Requires numpy and scipy.
+"""
+
+import os
+import re
+import sys
+
+import numpy as np
+from scipy import optimize, signal
+
+FS = 48000.0
+SECTIONS = 3
+RESTARTS = 40
+INFRASOUND_WEIGHT = 100.0   # residual per unit of the power share that lands below 20Hz
+LOW_POLE_MAX_F = 100.0      # only the first section's poles may sit below this
+LOW_POLE_MAX_Q = 1.0        # and their Q is kept at or below this, no resonant peak
+HIGH_POLE_MIN_F = 200.0     # every other section's pole pair starts here
+PHONS = [20, 40, 60, 80]
+
+# ISO 226:2003 table 1
+ISO_F = np.array([20, 25, 31.5, 40, 50, 63, 80, 100, 125, 160, 200, 250, 315, 400, 500, 630, 800,
+                  1000, 1250, 1600, 2000, 2500, 3150, 4000, 5000, 6300, 8000, 10000, 12500])
+ISO_AF = np.array([0.532, 0.506, 0.480, 0.455, 0.432, 0.409, 0.387, 0.367, 0.349, 0.330, 0.315,
+                   0.301, 0.288, 0.276, 0.267, 0.259, 0.253, 0.250, 0.246, 0.244, 0.243, 0.243,
+                   0.243, 0.242, 0.242, 0.245, 0.254, 0.271, 0.301])
+ISO_LU = np.array([-31.6, -27.2, -23.0, -19.1, -15.9, -13.0, -10.3, -8.1, -6.2, -4.5, -3.1, -2.0,
+                   -1.1, -0.4, 0.0, 0.3, 0.5, 0.0, -2.7, -4.1, -1.0, 1.7, 2.5, 1.2, -2.1, -7.1,
+                   -11.2, -10.7, -3.1])
+ISO_TF = np.array([78.5, 68.7, 59.5, 51.1, 44.0, 37.5, 31.5, 26.5, 22.1, 17.9, 14.4, 11.4, 8.6,
+                   6.2, 4.4, 3.0, 2.2, 2.4, 3.5, 1.7, -1.3, -4.2, -6.0, -5.4, -1.5, 6.0, 12.6,
+                   13.9, 12.3])
+
+
+def iso226(phon):
+    af = 4.47e-3 * (10.0 ** (0.025 * phon) - 1.15) + \
+        (0.4 * 10.0 ** (((ISO_TF + ISO_LU) / 10.0) - 9.0)) ** ISO_AF
+    return (10.0 / ISO_AF) * np.log10(af) - ISO_LU + 94.0
+
+
+def target(phon, f):
+    # the contour is only defined from 20Hz to 12.5kHz, hold the end values outside of that.
+    # below 20Hz the fit ignores it, see fit()
+    return np.interp(np.log(f), np.log(ISO_F), iso226(phon))
+
+
+def bilinear(c1, c0):
+    # s^2 + c1 s + c0 with s = 2 fs (z - 1) / (z + 1)
+    k = 2.0 * FS
+    return np.array([k * k + c1 * k + c0, 2.0 * c0 - 2.0 * k * k, k * k - c1 * k + c0])
+
+
+def sections(p):
+    # each section is an analog zero pair and pole pair given as log frequency and log Q, moved to
+    # the z plane with the bilinear transform so every candidate is stable and minimum phase
+    sos = []
+    for i in range(SECTIONS):
+        zf, zq, pf, pq = np.clip(p[4 * i:4 * i + 4], -30.0, 30.0)
+        wz = 2.0 * FS * np.tan(np.pi * min(np.exp(zf), 0.49 * FS) / FS)
+        wp = 2.0 * FS * np.tan(np.pi * min(np.exp(pf), 0.49 * FS) / FS)
+        b = bilinear(wz / np.exp(zq), wz * wz)
+        a = bilinear(wp / np.exp(pq), wp * wp)
+        sos.append(list(b / a[0]) + list(a / a[0]))
+    return np.array(sos)
+
+
+def dc_distance(section):
+    # how close the section's nearest pole is to z = 1
+    return np.min(np.abs(np.roots(section[3:]) - 1.0))
+
+
+def band_power(sos):
+    # mean power gain over 20Hz to 20kHz, white noise has 1
+    _, h = signal.sosfreqz(sos, worN=np.linspace(20.0, 20000.0, 20000), fs=FS)
+    return np.mean(np.abs(h) ** 2)
+
+
+def response_db(sos, f):
+    _, h = signal.sosfreqz(sos, worN=f, fs=FS)
+    return 20.0 * np.log10(np.abs(h) + 1e-30)
+
+
+def fit(phon, f, rng):
+    goal = target(phon, f)
+    audible = f >= ISO_F[0]
+    df = np.gradient(f)
+
+    def residual(p):
+        # the contour peaks at 20Hz so following it any lower piles power into infrasound.  below
+        # 20Hz only the share of power that ends up there counts, above it the error in dB does.
+        # overall gain is free, it gets set by the power normalisation below
+        response = response_db(sections(p), f)
+        err = response[audible] - goal[audible]
+        power = 10.0 ** (response / 10.0) * df
+        return np.append(err - np.mean(err), INFRASOUND_WEIGHT * np.sum(power[~audible]) / np.sum(power))
+
+    # the first section's pole pair is bounded to the low end with a capped Q, the others stay
+    # above it. a real pole pair (Q below 0.5) can still split towards DC, that does not ring
+    lower = np.full(4 * SECTIONS, -30.0)
+    upper = np.full(4 * SECTIONS, 30.0)
+    upper[2:4] = np.log(LOW_POLE_MAX_F), np.log(LOW_POLE_MAX_Q)
+    lower[4 + 2::4] = np.log(HIGH_POLE_MIN_F)
+
+    best = None
+    for _ in range(RESTARTS):
+        p0 = np.tile([np.log(1000.0), 0.0, np.log(1000.0), 0.0], SECTIONS) + \
+            rng.normal(0.0, [2.0, 1.0, 2.0, 1.0] * SECTIONS)
+        p0[2] = np.log(30.0) + rng.normal(0.0, 0.3)
+        p0 = np.clip(p0, lower + 1e-6, upper - 1e-6)
+        res = optimize.least_squares(residual, p0, bounds=(lower, upper))
+        if best is None or res.cost < best.cost:
+            best = res
+    sos = sections(best.x)
+
+    sos = sos[np.argsort([dc_distance(s) for s in sos])]
+    sos[0, :3] /= np.sqrt(band_power(sos))
+    return sos
+
+
+def load_table():
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "greyfilter.hpp")
+    text = open(path).read()
+    table = text[text.index("greyCoeffs"):text.index("};")]
+    values = [float(v) for v in re.findall(r"[-+]?\d\.\d+e[-+]\d+", table)]
+    return np.array(values, dtype=np.float32).reshape(len(PHONS), SECTIONS, 5)
+
+
+def run_float32(table, x, levels):
+    # transposed direct form II in float32 like dsp::BiQuad::process_so, the state is cleared
+    # whenever the level changes like GreyFilter::setLevel
+    z = np.zeros((SECTIONS, 2), dtype=np.float32)
+    y = np.empty(len(x), dtype=np.float32)
+    level = None
+    for n in range(len(x)):
+        if levels[n] != level:
+            level = levels[n]
+            z[:] = 0.0
+        acc = np.float32(x[n])
+        for i in range(SECTIONS):
+            ff0, ff1, ff2, fb1, fb2 = table[level, i]
+            xn = acc
+            acc = ff0 * xn + z[i, 0]
+            z[i, 0] = ff1 * xn + z[i, 1] - fb1 * acc
+            z[i, 1] = ff2 * xn - fb2 * acc
+        y[n] = acc
+    return y
+
+
+def low_pole(rows):
+    # frequency and Q of the highest Q pole below LOW_POLE_MAX_F in one level's rows of the table,
+    # mapped back through the bilinear transform. a real pole counts as Q 0.5
+    z = np.concatenate([np.roots([1.0, row[3], row[4]]) for row in rows.astype(np.float64)])
+    s = 2.0 * FS * (z - 1.0) / (z + 1.0)
+    s = s[np.abs(s) / (2.0 * np.pi) < LOW_POLE_MAX_F]
+    q = np.where(np.abs(s.imag) > 0.0, np.abs(s) / (-2.0 * s.real), 0.5)
+    return np.abs(s[np.argmax(q)]) / (2.0 * np.pi), np.max(q)
+
+
+def measure(table, level, phon):
+    # impulse response in float32: max error against the contour from 20Hz to 12.5kHz, the level
+    # at 1kHz re white and the share of power below 20Hz
+    length = 1 << 17
+    f = np.fft.rfftfreq(length, 1.0 / FS)
+    band = (f >= ISO_F[0]) & (f <= ISO_F[-1])
+    impulse = np.zeros(length, dtype=np.float32)
+    impulse[0] = 1.0
+
+    h = np.abs(np.fft.rfft(run_float32(table, impulse, np.full(length, level))))
+    err = 20.0 * np.log10(h[band]) - target(phon, f[band])
+    err -= np.mean(err)
+    power = h ** 2
+    return (np.max(np.abs(err)), 10.0 * np.log10(np.interp(1000.0, f, power)),
+            100.0 * np.sum(power[f < 20.0]) / np.sum(power))
+
+
+def check():
+    table = load_table()
+
+    for level, phon in enumerate(PHONS):
+        err, mid, infrasound = measure(table, level, phon)
+        pole_f, pole_q = low_pole(table[level])
+        print("%d phon: max error %.2f dB, 1kHz %+.1f dB re white, %.1f%% of power below 20Hz, "
+              "low pole %.1fHz Q %.2f" % (phon, err, mid, infrasound, pole_f, pole_q))
+
+    # a second at each level, up and back down, on uniform noise like osc_white
+    rng = np.random.default_rng(1)
+    order = list(range(len(PHONS))) + list(range(len(PHONS) - 2, -1, -1))
+    levels = np.repeat(order, int(FS))
+    x = rng.uniform(-1.0, 1.0, len(levels)).astype(np.float32)
+    y = run_float32(table, x, levels)
+    print("level sweep: peak %.3f, rms %.3f, input rms %.3f" % (
+        np.max(np.abs(y)), np.sqrt(np.mean(y ** 2)), np.sqrt(np.mean(x ** 2))))
+
+
+def main():
+    rng = np.random.default_rng(226)
+    # dense below 20Hz so the power that lands there is measured properly
+    f = np.concatenate((np.geomspace(1.0, 20.0, 80, endpoint=False), np.geomspace(20.0, 22000.0, 240)))
+    for level, phon in enumerate(PHONS):
+        # round trip through the printed text so the error is that of the table as stored
+        rows = ["%.9e, %.9e, %.9e, %.9e, %.9e" % (s[0], s[1], s[2], s[4], s[5]) for s in fit(phon, f, rng)]
+        table = np.zeros((len(PHONS), SECTIONS, 5), dtype=np.float32)
+        table[level] = [[float(v) for v in row.split(",")] for row in rows]
+        print("    {   // %d phon, max error %.2f dB" % (phon, measure(table, level, phon)[0]))
+        for row in rows:
+            print("        { %s }," % ", ".join(v.strip() + "f" for v in row.split(",")))
+        print("    },")
+
+
+if __name__ == "__main__":
+    if "--check" in sys.argv[1:]:
+        check()
+    else:
+        main()
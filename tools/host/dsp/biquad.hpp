@@ -0,0 +1,76 @@
+/*
+ * Host stand-in for the logue-sdk dsp/biquad.hpp, only the parts the noise oscillator uses.
+ * same transposed direct form II and coefficient conventions as the SDK.
+ */
+
+#pragma once
+
+namespace dsp {
+
+  struct BiQuad {
+
+    struct Coeffs {
+      Coeffs(void) : ff0(0), ff1(0), ff2(0), fb1(0), fb2(0) {}
+
+      inline void setFOLP(const float k) {
+        const float kp1 = k + 1.f;
+        ff0 = k / kp1;
+        ff1 = k / kp1;
+        ff2 = 0;
+        fb1 = (k - 1.f) / kp1;
+        fb2 = 0;
+      }
+
+      inline void setFOHP(const float k) {
+        const float kp1 = k + 1.f;
+        ff0 = 1.f / kp1;
+        ff1 = -1.f / kp1;
+        ff2 = 0;
+        fb1 = (k - 1.f) / kp1;
+        fb2 = 0;
+      }
+
+      inline void setSOLP(const float k, const float q) {
+        const float k2 = k * k;
+        const float divisor = k2 * q + k + q;
+        ff0 = k2 * q / divisor;
+        ff1 = 2.f * ff0;
+        ff2 = ff0;
+        fb1 = 2.f * q * (k2 - 1.f) / divisor;
+        fb2 = (k2 * q - k + q) / divisor;
+      }
+
+      static inline float wc(const float fc, const float fsrecip) {
+        return fc * fsrecip;
+      }
+
+      float ff0, ff1, ff2, fb1, fb2;
+    };
+
+    BiQuad(void) : mZ1(0), mZ2(0) {}
+
+    inline void flush(void) {
+      mZ1 = mZ2 = 0;
+    }
+
+    inline float process_so(const float xn) {
+      float acc = mCoeffs.ff0 * xn + mZ1;
+      mZ1 = mCoeffs.ff1 * xn + mZ2;
+      mZ2 = mCoeffs.ff2 * xn;
+      mZ1 -= mCoeffs.fb1 * acc;
+      mZ2 -= mCoeffs.fb2 * acc;
+      return acc;
+    }
+
+    inline float process_fo(const float xn) {
+      float acc = mCoeffs.ff0 * xn + mZ1;
+      mZ1 = mCoeffs.ff1 * xn;
+      mZ1 -= mCoeffs.fb1 * acc;
+      return acc;
+    }
+
+    Coeffs mCoeffs;
+    float mZ1, mZ2;
+  };
+
+}
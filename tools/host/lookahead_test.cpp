@@ -0,0 +1,181 @@
+/*
+ * Runs the oscillator on a computer through NoiseLookahead and checks the parts that only
+ * exist in host builds: the ring sized from the host buffer, underrun counting, skipping blocks
+ * rendered before a parameter change, latest value parameters, and the metering and health
+ * APIs.  Exits with 1 if any check fails.
+ *
+ *   make -C tools/host check
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "noise.hpp"
+#include "noiselookahead.hpp"
+
+static int s_failures = 0;
+
+static void check(const bool ok, const char *what)
+{
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok){
+    s_failures++;
+  }
+}
+
+// shape knob value in the middle of a color's range, 0 is white up to 5 for grey
+static uint16_t shapeValue(const int color)
+{
+  return (uint16_t)((color * .17f + .085f) * 1023.f);
+}
+
+static float rms(const std::vector<int32_t> &buffer)
+{
+  double sum = 0.;
+  for (size_t i = 0; i < buffer.size(); i++){
+    const double x = q31_to_f32(buffer[i]);
+    sum += x * x;
+  }
+  return (float)sqrt(sum / buffer.size());
+}
+
+// the producer is far faster than real time, wait for it to fill the ring before timing anything
+static void waitFull(NoiseLookahead &lookahead)
+{
+  SpscRing<NoiseLookahead::Block> &ring = lookahead.blocks;
+  while (ring.head.load() - ring.tail.load() != ring.capacity()){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+// callbacks at the pace a host would make them, returns the underruns seen
+static uint32_t play(NoiseLookahead &lookahead, const uint32_t frames, const uint32_t callbacks)
+{
+  std::vector<int32_t> buffer(frames);
+  const std::chrono::microseconds period((uint64_t)frames * 1000000 / k_samplerate);
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  const uint32_t before = lookahead.underruns.load();
+
+  for (uint32_t i = 0; i < callbacks; i++){
+    lookahead.read(buffer.data(), frames);
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+  return lookahead.underruns.load() - before;
+}
+
+static void testRingSize(void)
+{
+  const uint32_t sizes[] = { 37, 64, 256, 512, 1024 };
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++){
+    const uint32_t frames = sizes[i];
+    const uint32_t callback = (frames + NoiseLookahead::k_block_frames - 1) / NoiseLookahead::k_block_frames;
+    const uint32_t needed = 2 * (callback + 1) > NoiseLookahead::k_min_blocks ? 2 * (callback + 1) : NoiseLookahead::k_min_blocks;
+    char what[96];
+
+    NoiseLookahead lookahead(frames);
+    snprintf(what, sizeof(what), "%u frames: ring holds %u blocks, needs %u", frames, lookahead.blocks.capacity(), needed);
+    check(lookahead.blocks.capacity() >= needed, what);
+
+    lookahead.param(k_user_osc_param_shape, shapeValue(5));
+    lookahead.start();
+    waitFull(lookahead);
+    const uint32_t underruns = play(lookahead, frames, k_samplerate / 4 / frames + 1);
+    lookahead.stop();
+
+    snprintf(what, sizeof(what), "%u frames: %u underruns over a quarter second", frames, underruns);
+    check(underruns == 0, what);
+  }
+}
+
+static void testUnderruns(void)
+{
+  NoiseLookahead lookahead(256);
+  std::vector<int32_t> buffer(256, 1);
+
+  // nothing rendered yet, the callback gets silence and counts it
+  lookahead.read(buffer.data(), 256);
+  bool silent = true;
+  for (size_t i = 0; i < buffer.size(); i++){
+    silent = silent && buffer[i] == 0;
+  }
+  check(silent && lookahead.underruns.load() == 1, "read before start is silent and counts one underrun");
+
+  // drain a stopped producer, the callback that runs out is counted once
+  lookahead.start();
+  waitFull(lookahead);
+  lookahead.stop();
+  const uint32_t frames = lookahead.blocks.capacity() * NoiseLookahead::k_block_frames;
+  lookahead.read(buffer.data(), 256);
+  check(lookahead.underruns.load() == 1, "full ring reads without underrun");
+  std::vector<int32_t> rest(frames);
+  lookahead.read(rest.data(), frames);
+  check(lookahead.underruns.load() == 2 && rest.back() == 0, "running dry counts an underrun and pads with silence");
+}
+
+static void testGenerationSkip(void)
+{
+  const uint32_t frames = 1024;
+  NoiseLookahead lookahead(frames);
+  std::vector<int32_t> buffer(frames);
+
+  lookahead.param(k_user_osc_param_shape, shapeValue(0));
+  lookahead.start();
+  waitFull(lookahead);
+  lookahead.read(buffer.data(), frames);
+  const float white = rms(buffer);
+
+  // the ring is full of white so the callback right after the change still plays it, the
+  // producer renders brown into the slots it frees and the one after skips the rest of the white
+  lookahead.param(k_user_osc_param_shape, shapeValue(2));
+  play(lookahead, frames, 1);
+  lookahead.read(buffer.data(), frames);
+  const float brown = rms(buffer);
+  lookahead.stop();
+
+  char what[96];
+  snprintf(what, sizeof(what), "white to brown within one callback of a full ring, rms %.3f then %.3f", white, brown);
+  check(white > .2f && brown < white / 4.f, what);
+}
+
+static void testLatestParam(void)
+{
+  const uint32_t frames = 256;
+  NoiseLookahead lookahead(frames);
+
+  // far more changes than the producer can apply one by one, only the last one matters
+  lookahead.start();
+  for (int i = 0; i < 1000; i++){
+    lookahead.param(k_user_osc_param_shape, shapeValue(i % 4));
+  }
+  lookahead.param(k_user_osc_param_shape, shapeValue(4));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  noise_meter_reset();
+  play(lookahead, frames, 20);
+  lookahead.stop();
+
+  bool onlyViolet = noise_meter_stats(4).blocks > 0;
+  for (uint8_t color = 0; color < BlockMeter::k_colors; color++){
+    onlyViolet = onlyViolet && (color == 4 || noise_meter_stats(color).blocks == 0);
+  }
+  check(onlyViolet, "a burst of 1001 changes ends on the last value");
+  check(noise_meter_stats(BlockMeter::k_colors).blocks == 0, "meter stats past the last color are empty");
+
+  const HealthStats health = noise_health_stats();
+  check(health.nanTotal == 0 && health.overflowTotal == 0, "no NaN or overflow in the filter states");
+}
+
+int main(void)
+{
+  testRingSize();
+  testUnderruns();
+  testGenerationSkip();
+  testLatestParam();
+
+  printf("%d failed\n", s_failures);
+  return s_failures ? 1 : 0;
+}
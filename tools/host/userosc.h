@@ -0,0 +1,85 @@
+/*
+ * Host stand-in for the logue-sdk userosc.h, just enough of the oscillator API, fixed_math.h,
+ * float_math.h and osc_api.h for the noise oscillator to build and run on a computer.  the
+ * definitions follow the SDK, osc_white() and osc_rand() are a plain xorshift instead of the
+ * firmware's generator.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+#define PI 3.14159265358979323846f
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+#define f32_to_q31(f)   ((q31_t)((float)(f) * (float)0x7FFFFFFF))
+#define q31_to_f32(q)   ((float)(q) * 4.65661287307739e-010f)
+#define f32_to_q15(f)   ((q15_t)((float)(f) * (float)0x7FFF))
+#define q15_to_f32(q)   ((float)(q) * 3.05185094759972e-005f)
+#define q15_to_q31(q)   ((q31_t)((uint32_t)(q) << 16))
+
+#define param_val_to_f32(val) ((uint16_t)(val) * 9.77517106549365e-004f)
+
+#define k_samplerate        48000
+#define k_samplerate_recipf (2.08333333333333e-005f)
+
+static inline float si_fabsf(float x) { return fabsf(x); }
+static inline float clipmaxf(float x, float m) { return (x > m) ? m : x; }
+static inline float clipminf(float m, float x) { return (x < m) ? m : x; }
+static inline float clip1m1f(float x) { return (x > 1.f) ? 1.f : ((x < -1.f) ? -1.f : x); }
+
+static inline uint32_t osc_rand(void) {
+  static uint32_t state = 0x9E3779B9;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// uniform in [-1, 1] like the firmware's white noise
+static inline float osc_white(void) {
+  return (float)(int32_t)osc_rand() * 4.65661287307739e-010f;
+}
+
+typedef struct user_osc_param {
+  int32_t  shape_lfo;
+  uint16_t pitch;
+  uint16_t cutoff;
+  uint16_t resonance;
+  uint16_t reserved0[3];
+} user_osc_param_t;
+
+enum {
+  k_user_osc_param_id1 = 0,
+  k_user_osc_param_id2,
+  k_user_osc_param_id3,
+  k_user_osc_param_id4,
+  k_user_osc_param_id5,
+  k_user_osc_param_id6,
+  k_user_osc_param_shape,
+  k_user_osc_param_shiftshape,
+  k_num_user_osc_param_id
+};
+
+#define OSC_INIT    _hook_init
+#define OSC_CYCLE   _hook_cycle
+#define OSC_NOTEON  _hook_on
+#define OSC_NOTEOFF _hook_off
+#define OSC_PARAM   _hook_param
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void _hook_init(uint32_t platform, uint32_t api);
+void _hook_cycle(const user_osc_param_t * const params, int32_t *yn, const uint32_t frames);
+void _hook_on(const user_osc_param_t * const params);
+void _hook_off(const user_osc_param_t * const params);
+void _hook_param(uint16_t index, uint16_t value);
+
+#ifdef __cplusplus
+}
+#endif